@@ -29,4 +29,18 @@ _write_cr3:
 	mov eax, [ebp+8]
 	mov cr3, eax
 	pop ebp
-	retn
\ No newline at end of file
+	retn
+
+global _read_cr4
+_read_cr4:
+	mov eax, cr4
+	retn
+
+global _write_cr4
+_write_cr4:
+	push ebp
+	mov ebp, esp
+	mov eax, [ebp+8]
+	mov cr4, eax
+	pop ebp
+	retn
@@ -0,0 +1,38 @@
+; File: fiber_low.asm
+;
+; Low-level switch between fibers (see fiber.H).
+;
+; ----------------------------------------------------------------------
+; fiber_switch(char ** _save_esp, char * _new_esp)
+;
+; Saves the callee-saved registers on the current stack and the stack
+; pointer into *_save_esp, then loads the stack pointer _new_esp and
+; restores the registers saved there. The caller-saved registers (eax,
+; ecx, edx) and the flags need no saving: the C calling convention lets a
+; called function clobber them.
+;
+; A new fiber's stack is set up to look like it was switched out by this
+; function: 4 registers, then the address to 'return' to (Fiber::start).
+; ----------------------------------------------------------------------
+
+global _fiber_switch
+
+section .text
+
+_fiber_switch:
+	mov	eax, [esp+4]		; _save_esp
+	mov	edx, [esp+8]		; _new_esp
+
+	push	ebp
+	push	ebx
+	push	esi
+	push	edi
+
+	mov	[eax], esp		; save our stack pointer
+	mov	esp, edx		; and take the other one
+
+	pop	edi
+	pop	esi
+	pop	ebx
+	pop	ebp
+	ret
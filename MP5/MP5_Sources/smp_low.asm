@@ -0,0 +1,129 @@
+; File: smp_low.asm
+;
+; Start-up code for the application processors (APs).
+;
+; The code between _smp_trampoline_start and _smp_trampoline_end is copied
+; by the bootstrap processor (BSP) to physical address TRAMPOLINE_BASE,
+; below 1 MB, where an AP starts executing it in real mode after the
+; Startup IPI (SIPI vector TRAMPOLINE_BASE >> 12, i.e. CS = 0x0800, IP = 0).
+;
+; The AP loads a temporary flat GDT with the same selectors as the kernel
+; GDT (code 0x08, data 0x10), enters protected mode, loads the kernel GDT
+; and IDT, takes the stack that the BSP left in _smp_ap_stack, and calls
+; smp_ap_entry() (smp.C), which never returns.
+;
+; All references inside the trampoline are relative to its start: it runs
+; at TRAMPOLINE_BASE, not where it was linked.
+;
+; Also here: the entry points of the local APIC interrupts, on all CPUs.
+; The timer interrupt saves the registers like irq_common_stub
+; (irq_low.asm) and calls smp_lowlevel_timer() (smp.C); spurious
+; interrupts are ignored (no EOI).
+
+TRAMPOLINE_BASE equ 0x8000	; Keep in sync with SMP::TRAMPOLINE_BASE (smp.H)
+TIMER_VECTOR	equ 48		; Keep in sync with LocalAPIC::TIMER_VECTOR (smp.H)
+
+extern _gp			; kernel GDT pointer (gdt.C)
+extern _idtp			; kernel IDT pointer (idt.C)
+extern _smp_ap_stack		; top of the stack for the starting AP (smp.C)
+extern _smp_ap_entry		; C entry point of the APs (smp.C)
+extern _smp_lowlevel_timer	; local APIC timer interrupt (smp.C)
+
+global _smp_trampoline_start
+global _smp_trampoline_end
+global _smp_timer_irq
+global _smp_spurious_irq
+
+section .text
+
+; ----------------------------------------------------------------------
+; 16-bit real mode entry
+; ----------------------------------------------------------------------
+[bits 16]
+_smp_trampoline_start:
+	cli
+	cld
+	mov	ax, cs			; CS = TRAMPOLINE_BASE >> 4
+	mov	ds, ax
+
+	; Temporary GDT; its address is relative to DS
+	lgdt	[trampoline_gdt_ptr - _smp_trampoline_start]
+
+	mov	eax, cr0
+	or	eax, 1			; PE: enter protected mode
+	mov	cr0, eax
+
+	; Far jump into 32-bit code, at its copy below 1 MB
+	jmp	dword 0x08:(TRAMPOLINE_BASE + (trampoline_pm - _smp_trampoline_start))
+
+; ----------------------------------------------------------------------
+; 32-bit protected mode
+; ----------------------------------------------------------------------
+[bits 32]
+trampoline_pm:
+	mov	ax, 0x10
+	mov	ds, ax
+	mov	es, ax
+	mov	fs, ax
+	mov	gs, ax
+	mov	ss, ax
+
+	; The kernel's own tables (same selectors, so no reload is needed)
+	lgdt	[_gp]
+	lidt	[_idtp]
+
+	mov	esp, [_smp_ap_stack]
+	xor	ebp, ebp
+
+	mov	eax, _smp_ap_entry	; absolute: we do not run where we were linked
+	call	eax
+
+.park:
+	cli
+	hlt
+	jmp	.park
+
+; ----------------------------------------------------------------------
+; Temporary GDT: null, flat 4 GB code (0x08), flat 4 GB data (0x10)
+; ----------------------------------------------------------------------
+align 8
+trampoline_gdt:
+	dq	0x0000000000000000
+	dq	0x00CF9A000000FFFF
+	dq	0x00CF92000000FFFF
+
+trampoline_gdt_ptr:
+	dw	3 * 8 - 1
+	dd	TRAMPOLINE_BASE + (trampoline_gdt - _smp_trampoline_start)
+
+_smp_trampoline_end:
+
+; ----------------------------------------------------------------------
+; Local APIC interrupts
+; ----------------------------------------------------------------------
+[bits 32]
+_smp_timer_irq:
+	push	byte 0			; error code
+	push	byte TIMER_VECTOR	; interrupt number
+	pusha
+	push	ds
+	push	es
+	push	fs
+	push	gs
+
+	mov	eax, esp		; REGS * of the interrupted context
+	push	eax
+	mov	eax, _smp_lowlevel_timer
+	call	eax
+	pop	eax
+
+	pop	gs
+	pop	fs
+	pop	es
+	pop	ds
+	popa
+	add	esp, 8			; interrupt number and error code
+	iret
+
+_smp_spurious_irq:
+	iret
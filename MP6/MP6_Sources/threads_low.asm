@@ -94,26 +94,24 @@ _threads_low_switch_to:
 	; Save general purpose registers.
 	save_registers
 
+	; Top the frame off with the address of the code that resumes it.
+	push	dword _threads_low_resume_full
+
 	; Save stack pointer in the thread context struct (at offset 0).
 	mov	eax, [_current_thread]
 	mov	[eax+0], esp
 
 	; Load the pointer to the new thread context into eax.
-	; We skip over the Interrupt_State struct on the stack to
-	; get the parameter.
-	mov	eax, dword [esp+INTERRUPT_STATE_SIZE]
+	; We skip over the Interrupt_State struct and the resume address
+	; on the stack to get the parameter.
+	mov	eax, dword [esp+INTERRUPT_STATE_SIZE+4]
 
 	; Make the new thread current, and switch to its stack.
 	mov	[_current_thread], eax
 	mov	esp, [eax+0]
 
-	; Restore general purpose and segment registers, and clear interrupt
-	; number and error code.
-	restore_registers
-
-	; We'll return to the place where the thread was
-	; executing last.
-	iret
+	; Resume the new thread the way its context was saved.
+	ret
 
 .context_load_only:
 
@@ -125,6 +123,67 @@ _threads_low_switch_to:
 	mov	[_current_thread], eax
 	mov	esp, [eax+0]
 
+	; Resume the new thread the way its context was saved.
+	ret
+
+
+; ----------------------------------------------------------------------
+; threads_low_switch_fast(Thread * _thread)
+;
+; Lightweight version of threads_low_switch_to for switches made by a
+; function call. The C calling convention lets the caller assume that
+; only ebx, esi, edi, ebp (and esp) survive the call, so these, and the
+; return address, are all that we save. The thread is resumed with a
+; plain 'ret': no eflags, no segment registers, no iret.
+;
+; Every saved context, full or lightweight, ends with the address of
+; the code that resumes it (_threads_low_resume_full or _fast). The
+; switch routines simply 'ret' into it, so either routine can switch
+; to a thread that was switched out by the other.
+; ----------------------------------------------------------------------
+
+global _threads_low_switch_fast
+align 16
+_threads_low_switch_fast:
+
+	; The new thread.
+	mov	eax, [esp+4]
+
+	; No context to save for the start-up thread.
+	cmp	[_current_thread], dword 0
+	je	.load_only
+
+	; Save the callee-saved registers; the return address is on the
+	; stack already.
+	push	ebp
+	push	ebx
+	push	esi
+	push	edi
+	push	dword _threads_low_resume_fast
+
+	; Save stack pointer in the thread context struct (at offset 0).
+	mov	ecx, [_current_thread]
+	mov	[ecx+0], esp
+
+.load_only:
+
+	; Make the new thread current, and switch to its stack.
+	mov	[_current_thread], eax
+	mov	esp, [eax+0]
+
+	; Resume the new thread the way its context was saved.
+	ret
+
+
+; ----------------------------------------------------------------------
+; Resume routines. Not to be called: the switch routines 'ret' into them
+; with esp pointing just above the resume address.
+; ----------------------------------------------------------------------
+
+global _threads_low_resume_full
+align 16
+_threads_low_resume_full:
+
 	; Restore general purpose and segment registers, and clear interrupt
 	; number and error code.
 	restore_registers
@@ -132,3 +191,15 @@ _threads_low_switch_to:
 	; We'll return to the place where the thread was
 	; executing last.
 	iret
+
+global _threads_low_resume_fast
+align 16
+_threads_low_resume_fast:
+
+	; Restore the callee-saved registers, and return to the caller of
+	; threads_low_switch_fast.
+	pop	edi
+	pop	esi
+	pop	ebx
+	pop	ebp
+	ret